@@ -1,4 +1,5 @@
 # test_client.py
+import json
 import requests
 
 class DBCPClient:
@@ -22,6 +23,14 @@ class DBCPClient:
             json={"sql": sql},
             headers=self.headers
         ).json()
+
+    def load(self, table, rows):
+        body = "\n".join(json.dumps(row) for row in rows)
+        return requests.post(
+            f"{self.base_url}/load/{table}",
+            data=body,
+            headers={**self.headers, "Content-Type": "application/x-ndjson"}
+        ).json()
     
 # Test it
 if __name__ == "__main__":
@@ -3,6 +3,7 @@
 #include "Connection.h"
 #include <string>
 #include <queue>
+#include <deque>
 #include <mutex>
 #include <atomic>
 #include <memory>
@@ -10,19 +11,42 @@
 #include <condition_variable>
 #include <thread>
 
+class ConnectionBudget;
+class PoolRegistry;
+
 class ConnectionPool
 {
     public:
-        static ConnectionPool& getConnectionPool() {
-            static ConnectionPool instance;
-            return instance;
-        }
+        // The default pool of the process-wide PoolRegistry
+        static ConnectionPool& getConnectionPool();
 
         // Delete Copy and Move
         ConnectionPool(const ConnectionPool&) = delete;
         ConnectionPool& operator=(const ConnectionPool&) = delete;
         ConnectionPool(ConnectionPool&&) = delete;
         ConnectionPool& operator=(ConnectionPool&&) = delete;
+        ~ConnectionPool();
+
+        // Which idle connection getConnection() hands out
+        enum class ReusePolicy {
+            FIFO, // least recently returned; spreads load over every connection
+            LIFO  // most recently returned; keeps a hot set and lets the rest idle out
+        };
+
+        // Configuration
+        struct Config {
+            std::string host{"localhost"};
+            uint16_t port{3306};
+            std::string unixSocket; // overrides host/port when set
+            std::string database;
+            std::string username;
+            std::string password;
+            int minSize{5};
+            int maxSize{20};
+            std::chrono::seconds maxIdleTime{60};
+            std::chrono::milliseconds connectionTimeout{5000};
+            ReusePolicy reusePolicy{ReusePolicy::FIFO};
+        };
 
         // get an available connection;
         std::shared_ptr<Connection> getConnection();
@@ -32,44 +56,51 @@ class ConnectionPool
             size_t activeConnections;
             uint64_t totalRequests;
             uint64_t timeoutCount;
+            uint64_t resetCount;
+            uint64_t resetDropCount;
         };
         Stats getStats() const;
+        const std::string& getName() const { return _name; }
+
+        // Close one idle connection above minSize so another pool can use
+        // its share of the global budget
+        bool shedIdleConnection();
 
     private:
-        ConnectionPool(); // Singleton
-        ~ConnectionPool();
-        bool loadConfig(const std::string& filename);
+        friend class PoolRegistry;
+        ConnectionPool(const std::string& name, const Config& config, ConnectionBudget& budget);
         void producerThread();
         void sweeperThread(); // Restore connection when exceed max idle time
+        void resetterThread(); // Reset dirty sessions before they are reused
         void initialize();
         void shutdown();
         std::unique_ptr<Connection> createConnection();
+        void discardConnection(std::unique_ptr<Connection> conn);
+        // Both expect _mu to be held
+        void returnConnection(std::unique_ptr<Connection> conn);
+        std::unique_ptr<Connection> takeConnection();
 
-        // Configuration
-        struct Config {
-            std::string host{"localhost"};
-            uint16_t port{3306};
-            std::string database;
-            std::string username;
-            std::string password;
-            int minSize{5};
-            int maxSize{20};
-            std::chrono::seconds maxIdleTime{60};
-            std::chrono::milliseconds connectionTimeout{5000};
-        };
-
+        std::string _name;
         Config _config;
+        ConnectionBudget& _budget;
         mutable std::mutex _mu;
         std::thread _producer;
         std::thread _sweeper;
-        std::queue<std::unique_ptr<Connection>> _availableConnections;
+        std::thread _resetter;
+        // Ordered by return time, oldest at the front, under either policy
+        std::deque<std::unique_ptr<Connection>> _availableConnections;
+        std::queue<std::unique_ptr<Connection>> _dirtyConnections;
         std::atomic<int> _activeConnections{0};
         std::atomic<bool> _shutdown{false};
         std::condition_variable _notEmpty;
         std::condition_variable _notFull;
+        std::condition_variable _dirtyPending;
+        std::condition_variable _sweeperWake;
         
         // Statistics
         std::atomic<int> _totalRequests{0};
         std::atomic<int> _timeoutCount{0};
+        std::atomic<uint64_t> _resetCount{0};
+        std::atomic<uint64_t> _resetDropCount{0};
 
-};
\ No newline at end of file
+};
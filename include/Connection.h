@@ -18,22 +18,57 @@ class Connection {
             std::string user,
             std::string password,
             std::string dbname);
+        // connect through a local mysqld Unix domain socket
+        bool connectUnix(std::string socketPath,
+            std::string user,
+            std::string password,
+            std::string dbname);
 
         // insert, delete, update
         bool update(std::string sql);
         // select
         std::unique_ptr<sql::ResultSet> query(std::string sql);
 
+        // Driver message of the last failed update() or query()
+        const std::string& getLastError() const { return _lastError; }
+
         bool isConnected() const;
         void disconnect();
+
+        // Session state that reset() can undo: open transaction, table
+        // and named locks, autocommit, current schema
+        void markDirty() { _dirty = true; }
+        // Session state reset() cannot undo: session or user variables,
+        // temporary tables; the connection must be replaced
+        void markNeedsReconnect() { _dirty = true; _needsReconnect = true; }
+        bool isDirty() const { return _dirty; }
+        // Roll back, release locks and restore autocommit and schema.
+        // Returns false if the session cannot be reset this way.
+        bool reset();
+
         void refreshAliveTime() { _aliveTime = std::chrono::high_resolution_clock::now(); }
         std::chrono::seconds getAliveTime() const {
             auto now = std::chrono::high_resolution_clock::now();
             return std::chrono::duration_cast<std::chrono::seconds>(now - _aliveTime);
         }
+        // Time the connection was last returned to the pool
+        void markIdle() { _idleSince = std::chrono::steady_clock::now(); }
+        std::chrono::steady_clock::time_point getIdleSince() const { return _idleSince; }
 
     private:
+        bool connectUrl(const std::string& url,
+            const std::string& user,
+            const std::string& password,
+            const std::string& dbname);
+
+        void noteSessionEffect(const std::string& sql);
+
         std::unique_ptr<sql::Connection> _conn;
         sql::Driver* _driver;
+        std::string _dbname;
+        std::string _lastError;
+        bool _dirty{false};
+        bool _needsReconnect{false};
         std::chrono::time_point<std::chrono::high_resolution_clock> _aliveTime;
+        std::chrono::steady_clock::time_point _idleSince;
 };
\ No newline at end of file
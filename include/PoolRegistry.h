@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CommonConnectionPool.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+
+// Caps the number of open connections across all pools. When the cap is
+// reached, acquire() asks the other pools to give back idle connections.
+class ConnectionBudget
+{
+    public:
+        explicit ConnectionBudget(int maxSize) : _maxSize(maxSize) {}
+
+        void addPool(ConnectionPool* pool);
+        // Reserve a slot for a new connection of requester
+        bool acquire(const ConnectionPool* requester);
+        void release();
+
+        int getMaxSize() const { return _maxSize; }
+        int getUsed() const;
+
+    private:
+        const int _maxSize;
+        mutable std::mutex _mu;
+        int _used{0};
+        std::vector<ConnectionPool*> _pools;
+};
+
+// Named pools built from one config file. Keys before the first [section]
+// are defaults for every section; without sections a single pool named
+// "default" is created.
+class PoolRegistry
+{
+    public:
+        static PoolRegistry& getRegistry() {
+            static PoolRegistry instance;
+            return instance;
+        }
+
+        // Delete Copy and Move
+        PoolRegistry(const PoolRegistry&) = delete;
+        PoolRegistry& operator=(const PoolRegistry&) = delete;
+        PoolRegistry(PoolRegistry&&) = delete;
+        PoolRegistry& operator=(PoolRegistry&&) = delete;
+
+        // nullptr if no pool has this name
+        ConnectionPool* getPool(const std::string& name) const;
+        ConnectionPool& getDefaultPool() const { return *_default; }
+        std::vector<std::string> getPoolNames() const;
+
+        const ConnectionBudget& getBudget() const { return *_budget; }
+        // Sum of all pools' stats
+        ConnectionPool::Stats getAggregateStats() const;
+
+    private:
+        PoolRegistry(); // Singleton
+        ~PoolRegistry();
+        bool loadConfig(const std::string& filename);
+
+        std::map<std::string, ConnectionPool::Config> _configs;
+        int _globalMaxSize{0};
+
+        // The budget must outlive the pools that reference it
+        std::unique_ptr<ConnectionBudget> _budget;
+        std::map<std::string, std::unique_ptr<ConnectionPool>> _pools;
+        ConnectionPool* _default{nullptr};
+};
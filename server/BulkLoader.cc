@@ -0,0 +1,364 @@
+#include "BulkLoader.h"
+#include <stdexcept>
+#include <algorithm>
+
+using json = nlohmann::json;
+
+BulkLoader::BulkLoader(Executor execute, const std::string& table,
+                       Format format, size_t max_batch_bytes)
+    : execute_(std::move(execute)), table_(table), format_(format),
+      max_batch_bytes_(max_batch_bytes) {
+    writer_ = std::thread(&BulkLoader::writerLoop, this);
+}
+
+BulkLoader::~BulkLoader() {
+    abort();
+}
+
+void BulkLoader::abort() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        pending_.clear();
+        pending_rows_ = 0;
+        has_pending_ = false;
+    }
+    stopWriter();
+}
+
+void BulkLoader::stopWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        done_ = true;
+    }
+    cv_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+void BulkLoader::feed(const char* data, size_t length) {
+    bytes_ += length;
+    if (format_ == Format::NDJSON) {
+        feedNdjson(data, length);
+    } else {
+        feedCsv(data, length);
+    }
+}
+
+void BulkLoader::finish() {
+    if (format_ == Format::NDJSON) {
+        if (!line_.empty()) {
+            consumeNdjsonLine(line_);
+            line_.clear();
+        }
+    } else {
+        if (in_quotes_ && !quote_pending_) {
+            throw FormatError("Unterminated quoted CSV field");
+        }
+        endCsvRecord();
+    }
+
+    if (batch_rows_ > 0) {
+        flushBatch();
+    }
+
+    stopWriter();
+    rethrowWriterError();
+}
+
+void BulkLoader::feedNdjson(const char* data, size_t length) {
+    const char* end = data + length;
+    while (data < end) {
+        const char* newline = std::find(data, end, '\n');
+        line_.append(data, newline);
+        if (line_.size() > max_batch_bytes_) {
+            throw FormatError("NDJSON row " + std::to_string(rows_ + 1) + " exceeds batch_bytes");
+        }
+        if (newline == end) break;
+
+        consumeNdjsonLine(line_);
+        line_.clear();
+        data = newline + 1;
+    }
+}
+
+void BulkLoader::consumeNdjsonLine(const std::string& line) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) return;
+
+    json row;
+    try {
+        row = json::parse(line);
+    } catch (const json::parse_error& e) {
+        throw FormatError("NDJSON row " + std::to_string(rows_ + 1) + ": " + e.what());
+    }
+    if (!row.is_object()) {
+        throw FormatError("NDJSON row " + std::to_string(rows_ + 1) + " is not an object");
+    }
+
+    // The first row fixes the column list; missing keys become NULL
+    if (columns_.empty()) {
+        std::vector<std::string> columns;
+        for (auto& item : row.items()) {
+            columns.push_back(item.key());
+        }
+        setColumns(columns);
+    }
+
+    std::vector<std::string> literals;
+    literals.reserve(columns_.size());
+    size_t matched = 0;
+    for (const auto& column : columns_) {
+        auto it = row.find(column);
+        if (it == row.end()) {
+            literals.push_back("NULL");
+        } else {
+            literals.push_back(jsonToLiteral(*it));
+            matched++;
+        }
+    }
+
+    // Keys outside the column list would otherwise be dropped silently
+    if (matched != row.size()) {
+        for (auto& item : row.items()) {
+            if (std::find(columns_.begin(), columns_.end(), item.key()) == columns_.end()) {
+                throw FormatError("NDJSON row " + std::to_string(rows_ + 1) +
+                                  " has unknown column '" + item.key() + "'");
+            }
+        }
+    }
+    addRow(literals);
+}
+
+void BulkLoader::feedCsv(const char* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        char c = data[i];
+
+        // Bounds memory for records that never end, header included
+        if (++record_bytes_ > max_batch_bytes_) {
+            throw FormatError(csvRecordName() + " exceeds batch_bytes");
+        }
+
+        if (quote_pending_) {
+            // A quote inside a quoted field is either "" or the closing quote
+            quote_pending_ = false;
+            if (c == '"') {
+                field_ += '"';
+                continue;
+            }
+            in_quotes_ = false;
+        }
+
+        if (in_quotes_) {
+            if (c == '"') {
+                quote_pending_ = true;
+            } else {
+                field_ += c;
+            }
+            continue;
+        }
+
+        switch (c) {
+            case '"':
+                in_quotes_ = true;
+                field_quoted_ = true;
+                break;
+            case ',':
+                endCsvField();
+                break;
+            case '\r':
+                break;
+            case '\n':
+                endCsvRecord();
+                break;
+            default:
+                field_ += c;
+        }
+    }
+}
+
+void BulkLoader::endCsvField() {
+    record_.push_back(std::move(field_));
+    record_null_.push_back(!field_quoted_ && record_.back() == "\\N");
+    field_.clear();
+    field_quoted_ = false;
+
+    if (!columns_.empty() && record_.size() > columns_.size()) {
+        throw FormatError(csvRecordName() + " has more than " +
+                          std::to_string(columns_.size()) + " fields");
+    }
+}
+
+std::string BulkLoader::csvRecordName() const {
+    return columns_.empty() ? "CSV header" : "CSV row " + std::to_string(rows_ + 1);
+}
+
+void BulkLoader::endCsvRecord() {
+    record_bytes_ = 0;
+    if (record_.empty() && field_.empty() && !field_quoted_) {
+        return; // blank line
+    }
+    endCsvField();
+
+    // The first record is the header
+    if (columns_.empty()) {
+        setColumns(record_);
+    } else {
+        if (record_.size() != columns_.size()) {
+            throw FormatError("CSV row " + std::to_string(rows_ + 1) + " has " +
+                                     std::to_string(record_.size()) + " fields, expected " +
+                                     std::to_string(columns_.size()));
+        }
+        // Unquoted \N is NULL, as with LOAD DATA
+        std::vector<std::string> literals;
+        literals.reserve(record_.size());
+        for (size_t i = 0; i < record_.size(); ++i) {
+            literals.push_back(record_null_[i] ? "NULL" : quoteLiteral(record_[i]));
+        }
+        addRow(literals);
+    }
+    record_.clear();
+    record_null_.clear();
+}
+
+void BulkLoader::setColumns(const std::vector<std::string>& columns) {
+    if (columns.empty()) {
+        throw FormatError("No columns to load");
+    }
+    columns_ = columns;
+
+    insert_prefix_ = "INSERT INTO " + quoteIdentifier(table_) + " (";
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        if (i > 0) insert_prefix_ += ",";
+        insert_prefix_ += quoteIdentifier(columns_[i]);
+    }
+    insert_prefix_ += ") VALUES ";
+}
+
+void BulkLoader::addRow(const std::vector<std::string>& literals) {
+    std::string tuple = "(";
+    for (size_t i = 0; i < literals.size(); ++i) {
+        if (i > 0) tuple += ",";
+        tuple += literals[i];
+    }
+    tuple += ")";
+
+    // Quoting can grow a row past the raw size checked while parsing
+    if (insert_prefix_.size() + tuple.size() > max_batch_bytes_) {
+        throw FormatError("Row " + std::to_string(rows_ + 1) + " exceeds batch_bytes");
+    }
+
+    if (batch_rows_ > 0 && batch_.size() + tuple.size() + 1 > max_batch_bytes_) {
+        flushBatch();
+    }
+
+    if (batch_rows_ == 0) {
+        batch_ = insert_prefix_;
+    } else {
+        batch_ += ",";
+    }
+    batch_ += tuple;
+    batch_rows_++;
+    rows_++;
+}
+
+void BulkLoader::flushBatch() {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this] { return !has_pending_ || error_; });
+    if (error_) {
+        lock.unlock();
+        rethrowWriterError();
+    }
+
+    pending_ = std::move(batch_);
+    pending_rows_ = batch_rows_;
+    has_pending_ = true;
+    batch_.clear();
+    batch_rows_ = 0;
+    batches_++;
+    cv_.notify_all();
+}
+
+void BulkLoader::writerLoop() {
+    while (true) {
+        std::string sql;
+        size_t sql_rows = 0;
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this] { return has_pending_ || done_; });
+            if (!has_pending_) break;
+
+            sql = std::move(pending_);
+            sql_rows = pending_rows_;
+            pending_.clear();
+            has_pending_ = false;
+        }
+        // Let the parser hand over the next batch while this one runs
+        cv_.notify_all();
+
+        std::string error;
+        if (!execute_(sql, error)) {
+            std::lock_guard<std::mutex> lock(mu_);
+            error_ = std::make_exception_ptr(std::runtime_error("Batch insert failed: " + error));
+            cv_.notify_all();
+            break;
+        }
+        committed_rows_ += sql_rows;
+        committed_batches_++;
+    }
+}
+
+void BulkLoader::rethrowWriterError() {
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        error = error_;
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+std::string BulkLoader::quoteIdentifier(const std::string& name) {
+    std::string quoted = "`";
+    for (char c : name) {
+        if (c == '`') quoted += '`';
+        quoted += c;
+    }
+    quoted += "`";
+    return quoted;
+}
+
+std::string BulkLoader::quoteLiteral(const std::string& value) {
+    std::string quoted;
+    quoted.reserve(value.size() + 2);
+    quoted += '\'';
+    for (char c : value) {
+        switch (c) {
+            case '\0':   quoted += "\\0"; break;
+            case '\'':   quoted += "\\'"; break;
+            case '"':    quoted += "\\\""; break;
+            case '\\':   quoted += "\\\\"; break;
+            case '\n':   quoted += "\\n"; break;
+            case '\r':   quoted += "\\r"; break;
+            case '\x1a': quoted += "\\Z"; break;
+            default:     quoted += c;
+        }
+    }
+    quoted += '\'';
+    return quoted;
+}
+
+std::string BulkLoader::jsonToLiteral(const json& value) {
+    switch (value.type()) {
+        case json::value_t::null:
+            return "NULL";
+        case json::value_t::boolean:
+            return value.get<bool>() ? "1" : "0";
+        case json::value_t::number_integer:
+        case json::value_t::number_unsigned:
+        case json::value_t::number_float:
+            return value.dump();
+        case json::value_t::string:
+            return quoteLiteral(value.get<std::string>());
+        default:
+            return quoteLiteral(value.dump());
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <condition_variable>
+#include "json.hpp"
+
+// Streams NDJSON or CSV rows into size-bounded multi-row INSERT batches.
+// A writer thread executes one batch while the next is being parsed, so at
+// most three batches (building, pending, executing) are held in memory.
+// Each batch commits on its own: a failed load leaves earlier batches in
+// the table, and committedRows() says how many.
+class BulkLoader {
+public:
+    enum class Format { NDJSON, CSV };
+
+    // Runs one INSERT; on failure returns false and sets error
+    using Executor = std::function<bool(const std::string& sql, std::string& error)>;
+
+    // Malformed input, as opposed to a failed batch insert
+    class FormatError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // A single row, and the CSV header, must fit in max_batch_bytes
+    BulkLoader(Executor execute, const std::string& table,
+               Format format, size_t max_batch_bytes);
+    // Drops any batch not yet handed to the writer
+    ~BulkLoader();
+
+    BulkLoader(const BulkLoader&) = delete;
+    BulkLoader& operator=(const BulkLoader&) = delete;
+
+    // Parse a chunk of the request body; throws if a batch insert failed
+    void feed(const char* data, size_t length);
+    // Flush the remaining rows and wait for the writer to drain
+    void finish();
+    // Discard the pending batch and wait for the one being executed
+    void abort();
+
+    uint64_t rows() const { return rows_; }
+    uint64_t batches() const { return batches_; }
+    uint64_t bytes() const { return bytes_; }
+    uint64_t committedRows() const { return committed_rows_; }
+    uint64_t committedBatches() const { return committed_batches_; }
+
+private:
+    void feedNdjson(const char* data, size_t length);
+    void feedCsv(const char* data, size_t length);
+    void consumeNdjsonLine(const std::string& line);
+    void endCsvField();
+    void endCsvRecord();
+    std::string csvRecordName() const;
+
+    void setColumns(const std::vector<std::string>& columns);
+    void addRow(const std::vector<std::string>& literals);
+    void flushBatch();
+    void writerLoop();
+    void stopWriter();
+    void rethrowWriterError();
+
+    static std::string quoteIdentifier(const std::string& name);
+    static std::string quoteLiteral(const std::string& value);
+    static std::string jsonToLiteral(const nlohmann::json& value);
+
+    Executor execute_;
+    std::string table_;
+    Format format_;
+    size_t max_batch_bytes_;
+
+    std::vector<std::string> columns_;
+    std::string insert_prefix_;
+    std::string batch_;
+    size_t batch_rows_{0};
+
+    // NDJSON state
+    std::string line_;
+    // CSV state
+    std::string field_;
+    std::vector<std::string> record_;
+    std::vector<bool> record_null_;
+    size_t record_bytes_{0};
+    bool in_quotes_{false};
+    bool field_quoted_{false};
+    bool quote_pending_{false};
+
+    uint64_t rows_{0};
+    uint64_t batches_{0};
+    uint64_t bytes_{0};
+
+    // Single-slot handoff to the writer thread
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::string pending_;
+    size_t pending_rows_{0};
+    bool has_pending_{false};
+    bool done_{false};
+    std::exception_ptr error_;
+    std::thread writer_;
+
+    std::atomic<uint64_t> committed_rows_{0};
+    std::atomic<uint64_t> committed_batches_{0};
+};
@@ -1,14 +1,23 @@
 #include "DatabaseServer.h"
+#include "BulkLoader.h"
 #include <spdlog/spdlog.h>
 #include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <unistd.h>
+#include <sys/stat.h>
 
 using json = nlohmann::json;
 
 DatabaseServer::DatabaseServer(const std::string& auth_token)
-    : pool_(ConnectionPool::getConnectionPool()), auth_token_(auth_token) {
+    : pools_(PoolRegistry::getRegistry()), auth_token_(auth_token) {
     setupRoutes();
 }
 
+DatabaseServer::~DatabaseServer() {
+    removeUnixSocket();
+}
+
 void DatabaseServer::setupRoutes() {
     server_.set_pre_routing_handler([this](const httplib::Request& req, httplib::Response& res) {
         if (req.path == "/health") return httplib::Server::HandlerResponse::Unhandled;
@@ -21,44 +30,83 @@ void DatabaseServer::setupRoutes() {
         return httplib::Server::HandlerResponse::Unhandled;
     });
 
-    server_.Get("/health", [this](const httplib::Request&, httplib::Response& res) {
+    server_.Get("/health", [this](const httplib::Request& req, httplib::Response& res) {
         json response;
         response["status"] = "healthy";
-        response["pool_stats"] = getPoolStats();
+        response["pool_stats"] = getPoolStats(pools_.getAggregateStats());
+        // Pool names are tenant names; only list them to authenticated callers
+        if (authenticate(req)) {
+            response["pools"] = json::object();
+            for (const auto& name : pools_.getPoolNames()) {
+                response["pools"][name] = getPoolStats(pools_.getPool(name)->getStats());
+            }
+        }
+        response["global_max_size"] = pools_.getBudget().getMaxSize();
+        response["global_used"] = pools_.getBudget().getUsed();
+        response["coalescing"] = getCoalescingStats();
         res.set_content(response.dump(), "application/json");
     });
 
-    server_.Post("/query", [this](const httplib::Request& req, httplib::Response& res) {
+    server_.Post(R"((?:/pools/([A-Za-z0-9_-]+))?/query)", [this](const httplib::Request& req, httplib::Response& res) {
         try {
+            ConnectionPool* pool = routePool(req, res);
+            if (!pool) return;
             json request = json::parse(req.body);
             std::string sql = request["sql"];
             auto params = request.value("params", json::array());
 
-            auto conn = pool_.getConnection();
-            if (!conn) throw std::runtime_error("No connection available");
+            auto execute = [&]() {
+                auto conn = pool->getConnection();
+                if (!conn) throw std::runtime_error("No connection available");
 
-            spdlog::debug("Executing query: {}", sql);
+                spdlog::debug("Executing query: {}", sql);
 
-            auto start = std::chrono::high_resolution_clock::now();
-            auto results = conn->query(sql);
-            auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+                auto start = std::chrono::high_resolution_clock::now();
+                auto results = conn->query(sql);
+                auto end = std::chrono::high_resolution_clock::now();
+                auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
-            json response;
-            response["data"] = convertResultSet(results);
-            response["execution_time_ms"] = duration.count();
-            res.set_content(response.dump(), "application/json");
+                json response;
+                response["data"] = convertResultSet(results);
+                response["execution_time_ms"] = duration.count();
+                return response.dump();
+            };
+
+            // Coalesce when the request asks for it or its digest is allow-listed
+            std::string normalized = QueryCoalescer::normalize(sql);
+            std::string digest = QueryCoalescer::digest(normalized);
+            res.set_header("X-Query-Digest", digest);
+            bool coalesce = coalescer_.isAllowed(digest);
+            if (request.contains("coalesce")) {
+                if (!request["coalesce"].is_boolean()) {
+                    sendError(res, 400, "coalesce must be a boolean");
+                    return;
+                }
+                coalesce = request["coalesce"].get<bool>();
+            }
+
+            if (coalesce) {
+                bool shared = false;
+                std::string body = coalescer_.run(pool->getName() + '\0' + normalized + '\0' + params.dump(),
+                                                  execute, shared);
+                if (shared) res.set_header("X-Coalesced", "1");
+                res.set_content(body, "application/json");
+            } else {
+                res.set_content(execute(), "application/json");
+            }
         } catch (const std::exception& e) {
             handleError(res, e);
         }
     });
 
-    server_.Post("/execute", [this](const httplib::Request& req, httplib::Response& res) {
+    server_.Post(R"((?:/pools/([A-Za-z0-9_-]+))?/execute)", [this](const httplib::Request& req, httplib::Response& res) {
         try {
+            ConnectionPool* pool = routePool(req, res);
+            if (!pool) return;
             json request = json::parse(req.body);
             std::string sql = request["sql"];
 
-            auto conn = pool_.getConnection();
+            auto conn = pool->getConnection();
             if (!conn) throw std::runtime_error("No connection available");
 
             bool success = conn->update(sql);
@@ -70,6 +118,90 @@ void DatabaseServer::setupRoutes() {
             handleError(res, e);
         }
     });
+
+    server_.Post(R"((?:/pools/([A-Za-z0-9_-]+))?/load/([A-Za-z0-9_]+))",
+                 [this](const httplib::Request& req, httplib::Response& res,
+                        const httplib::ContentReader& content_reader) {
+        try {
+            ConnectionPool* pool = routePool(req, res);
+            if (!pool) return;
+            std::string table = req.matches[2];
+            auto format = req.get_header_value("Content-Type").find("csv") != std::string::npos ||
+                          req.get_param_value("format") == "csv"
+                ? BulkLoader::Format::CSV
+                : BulkLoader::Format::NDJSON;
+
+            size_t batch_bytes = kDefaultLoadBatchBytes;
+            if (req.has_param("batch_bytes")) {
+                std::string value = req.get_param_value("batch_bytes");
+                if (value.empty() || value.size() > 12 ||
+                    value.find_first_not_of("0123456789") != std::string::npos) {
+                    sendError(res, 400, "batch_bytes must be a positive integer");
+                    return;
+                }
+                batch_bytes = std::clamp<size_t>(std::stoull(value), kMinLoadBatchBytes, kMaxLoadBatchBytes);
+            }
+
+            auto conn = pool->getConnection();
+            if (!conn) throw std::runtime_error("No connection available");
+
+            spdlog::debug("Bulk loading into {}", table);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            BulkLoader loader([conn](const std::string& sql, std::string& error) {
+                if (conn->update(sql)) return true;
+                error = conn->getLastError();
+                return false;
+            }, table, format, batch_bytes);
+
+            // Batches commit independently, so report what made it in
+            auto fail = [&](int status, const std::string& message) {
+                loader.abort();
+                json error;
+                error["error"] = message;
+                error["rows_committed"] = loader.committedRows();
+                error["batches_committed"] = loader.committedBatches();
+                res.status = status;
+                res.set_content(error.dump(), "application/json");
+            };
+
+            try {
+                std::exception_ptr error;
+                content_reader([&](const char* data, size_t length) {
+                    try {
+                        loader.feed(data, length);
+                        return true;
+                    } catch (...) {
+                        error = std::current_exception();
+                        return false;
+                    }
+                });
+                if (error) std::rethrow_exception(error);
+                loader.finish();
+            } catch (const BulkLoader::FormatError& e) {
+                fail(400, e.what());
+                return;
+            } catch (const std::exception& e) {
+                spdlog::error("Bulk load into {} failed: {}", table, e.what());
+                fail(500, e.what());
+                return;
+            }
+
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration<double, std::milli>(end - start);
+            double seconds = duration.count() / 1000.0;
+
+            json response;
+            response["rows"] = loader.rows();
+            response["batches"] = loader.batches();
+            response["bytes"] = loader.bytes();
+            response["execution_time_ms"] = static_cast<int64_t>(duration.count());
+            response["rows_per_sec"] = seconds > 0 ? loader.rows() / seconds : 0.0;
+            res.set_content(response.dump(), "application/json");
+        } catch (const std::exception& e) {
+            handleError(res, e);
+        }
+    });
 }
 
 bool DatabaseServer::authenticate(const httplib::Request& req) {
@@ -77,14 +209,43 @@ bool DatabaseServer::authenticate(const httplib::Request& req) {
     return auth_header == "Bearer " + auth_token_;
 }
 
-json DatabaseServer::getPoolStats() {
-    auto stats = pool_.getStats();
+ConnectionPool* DatabaseServer::routePool(const httplib::Request& req, httplib::Response& res) {
+    // Path prefix /pools/<name>/ wins over the X-Pool header
+    std::string name = req.matches.size() > 1 ? req.matches[1].str() : "";
+    if (name.empty()) {
+        name = req.get_header_value("X-Pool");
+    }
+    if (name.empty()) {
+        return &pools_.getDefaultPool();
+    }
+
+    auto* pool = pools_.getPool(name);
+    if (!pool) {
+        sendError(res, 404, "Unknown pool: " + name);
+    }
+    return pool;
+}
+
+json DatabaseServer::getPoolStats(const ConnectionPool::Stats& stats) {
     json result;
     result["total_connections"] = stats.totalConnections;
     result["available_connections"] = stats.availableConnections;
     result["active_connections"] = stats.activeConnections;
     result["total_requests"] = stats.totalRequests;
     result["timeout_count"] = stats.timeoutCount;
+    result["reset_count"] = stats.resetCount;
+    result["reset_drop_count"] = stats.resetDropCount;
+    return result;
+}
+
+json DatabaseServer::getCoalescingStats() {
+    auto stats = coalescer_.getStats();
+    json result;
+    result["executions"] = stats.executions;
+    result["shared_results"] = stats.shared;
+    result["fan_in_ratio"] = stats.executions > 0
+        ? static_cast<double>(stats.executions + stats.shared) / stats.executions
+        : 0.0;
     return result;
 }
 
@@ -122,6 +283,13 @@ json DatabaseServer::convertResultSet(std::unique_ptr<sql::ResultSet>& rs) {
     return rows;
 }
 
+void DatabaseServer::sendError(httplib::Response& res, int status, const std::string& message) {
+    res.status = status;
+    json error;
+    error["error"] = message;
+    res.set_content(error.dump(), "application/json");
+}
+
 void DatabaseServer::handleError(httplib::Response& res, const std::exception& e) {
     spdlog::error("Request error: {}", e.what());
     res.status = 500;
@@ -130,11 +298,131 @@ void DatabaseServer::handleError(httplib::Response& res, const std::exception& e
     res.set_content(error.dump(), "application/json");
 }
 
+void DatabaseServer::allowCoalescing(const std::string& digest) {
+    coalescer_.allowDigest(digest);
+}
+
 void DatabaseServer::start(int port) {
-    spdlog::info("Starting database server on port {}", port);
-    server_.listen("0.0.0.0", port);
+    if (bind(port)) serve();
+}
+
+void DatabaseServer::startUnix(const std::string& socket_path) {
+    if (bindUnix(socket_path)) serve();
 }
 
 void DatabaseServer::stop() {
     server_.stop();
 }
+
+bool DatabaseServer::bind(int port) {
+    spdlog::info("Binding database server on port {}", port);
+    server_.set_socket_options([](socket_t sock) {
+        int yes = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
+    });
+    if (!server_.bind_to_port("0.0.0.0", port)) {
+        spdlog::error("Failed to bind port {}", port);
+        return false;
+    }
+    warnIfNoRequestMigration();
+    return true;
+}
+
+void DatabaseServer::warnIfNoRequestMigration() {
+    // Without it, connections still in our accept backlog when drain()
+    // closes the socket are reset instead of moving to the new listener
+    std::ifstream sysctl("/proc/sys/net/ipv4/tcp_migrate_req");
+    int enabled = 0;
+    if (!(sysctl >> enabled) || enabled == 0) {
+        spdlog::warn("net.ipv4.tcp_migrate_req is not enabled; "
+                     "connections queued during a restart will be reset");
+    }
+}
+
+bool DatabaseServer::bindUnix(const std::string& socket_path) {
+    spdlog::info("Binding database server on unix socket {}", socket_path);
+    // Remove a stale socket left behind by a previous run, but never
+    // anything else that happens to live at this path
+    struct stat st;
+    if (::lstat(socket_path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            spdlog::error("Refusing to replace non-socket file {}", socket_path);
+            return false;
+        }
+        ::unlink(socket_path.c_str());
+    }
+
+    server_.set_address_family(AF_UNIX);
+    if (!server_.bind_to_port(socket_path, 80)) {
+        spdlog::error("Failed to bind unix socket {}", socket_path);
+        return false;
+    }
+
+    if (::lstat(socket_path.c_str(), &st) == 0) {
+        unix_socket_path_ = socket_path;
+        unix_socket_ino_ = st.st_ino;
+    }
+    return true;
+}
+
+void DatabaseServer::removeUnixSocket() {
+    if (unix_socket_path_.empty()) return;
+
+    // A replacement process may already have bound a new socket here
+    struct stat st;
+    if (::lstat(unix_socket_path_.c_str(), &st) == 0 &&
+        S_ISSOCK(st.st_mode) && st.st_ino == unix_socket_ino_) {
+        ::unlink(unix_socket_path_.c_str());
+    }
+    unix_socket_path_.clear();
+}
+
+void DatabaseServer::serve() {
+    server_.listen_after_bind();
+
+    // listen returns once the accept loop stops and workers have finished
+    std::lock_guard<std::mutex> lock(serve_mu_);
+    serve_done_ = true;
+    serve_done_cv_.notify_all();
+}
+
+bool DatabaseServer::drain(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    // stop() does nothing before the accept loop starts, so wait for it,
+    // but not past the deadline or once serve() has already returned
+    while (!server_.is_running()) {
+        {
+            std::lock_guard<std::mutex> lock(serve_mu_);
+            if (serve_done_) break;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            spdlog::warn("Drain timeout before the server started accepting");
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    server_.stop();
+    spdlog::info("Stopped accepting, draining in-flight requests");
+
+    {
+        std::unique_lock<std::mutex> lock(serve_mu_);
+        if (!serve_done_cv_.wait_until(lock, deadline, [this] { return serve_done_; })) {
+            spdlog::warn("Drain timeout with requests still in flight");
+            return false;
+        }
+    }
+
+    // Wait for leases held outside request handlers and pending resets
+    while (pools_.getAggregateStats().activeConnections > 0) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            spdlog::warn("Drain timeout with connections still leased");
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    spdlog::info("Drained");
+    return true;
+}
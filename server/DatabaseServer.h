@@ -1,24 +1,69 @@
 #pragma once
 
 #include <string>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <sys/types.h>
 #include <httplib.h>
 #include "json.hpp"
-#include "CommonConnectionPool.h"
+#include "PoolRegistry.h"
+#include "QueryCoalescer.h"
 
 class DatabaseServer {
 public:
     explicit DatabaseServer(const std::string& auth_token);
+    ~DatabaseServer();
     void start(int port);
+    void startUnix(const std::string& socket_path);
     void stop();
 
+    // Bind without accepting yet; SO_REUSEPORT lets a replacement process
+    // bind the same port while the old one drains
+    bool bind(int port);
+    bool bindUnix(const std::string& socket_path);
+    // Accept requests on the bound socket until stopped
+    void serve();
+    // Stop accepting, then wait up to timeout for in-flight requests and
+    // leases to finish. Returns false if the timeout expired first.
+    // Connections the kernel already queued on this listener but that
+    // were not accepted yet move to another SO_REUSEPORT listener only
+    // if net.ipv4.tcp_migrate_req is enabled; otherwise they are reset.
+    bool drain(std::chrono::milliseconds timeout);
+    // Coalesce /query requests whose normalized SQL has this digest
+    void allowCoalescing(const std::string& digest);
+
 private:
+    // Upper bound on the size of one multi-row INSERT issued by /load
+    static constexpr size_t kDefaultLoadBatchBytes = 1 << 20;
+    // Range accepted for the batch_bytes parameter; stays below the
+    // default max_allowed_packet of 64 MiB
+    static constexpr size_t kMinLoadBatchBytes = 4 << 10;
+    static constexpr size_t kMaxLoadBatchBytes = 16 << 20;
+
     httplib::Server server_;
-    ConnectionPool& pool_;
+    PoolRegistry& pools_;
     std::string auth_token_;
+    QueryCoalescer coalescer_;
+
+    std::mutex serve_mu_;
+    std::condition_variable serve_done_cv_;
+    bool serve_done_{false};
+
+    // Socket file created by bindUnix(), removed on destruction
+    std::string unix_socket_path_;
+    ino_t unix_socket_ino_{0};
 
     void setupRoutes();
     bool authenticate(const httplib::Request& req);
-    nlohmann::json getPoolStats();
+    void removeUnixSocket();
+    void warnIfNoRequestMigration();
+    // Replies 404 and returns nullptr for an unknown pool name
+    ConnectionPool* routePool(const httplib::Request& req, httplib::Response& res);
+    nlohmann::json getPoolStats(const ConnectionPool::Stats& stats);
+    nlohmann::json getCoalescingStats();
     nlohmann::json convertResultSet(std::unique_ptr<sql::ResultSet>& rs);
+    // Client error: reply with status and message without logging
+    void sendError(httplib::Response& res, int status, const std::string& message);
     void handleError(httplib::Response& res, const std::exception& e);
 };
\ No newline at end of file
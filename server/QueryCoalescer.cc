@@ -0,0 +1,110 @@
+#include "QueryCoalescer.h"
+#include <cstdio>
+
+std::string QueryCoalescer::run(const std::string& key, const Producer& producer, bool& shared) {
+    std::promise<std::string> promise;
+    {
+        std::unique_lock<std::mutex> lock(mu_);
+        auto it = in_flight_.find(key);
+        if (it != in_flight_.end()) {
+            auto future = it->second;
+            lock.unlock();
+            shared_++;
+            shared = true;
+            return future.get();
+        }
+        in_flight_.emplace(key, promise.get_future().share());
+    }
+
+    executions_++;
+    shared = false;
+
+    std::string result;
+    std::exception_ptr error;
+    try {
+        result = producer();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    // Unregister first so later arrivals start a fresh execution
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        in_flight_.erase(key);
+    }
+
+    if (error) {
+        promise.set_exception(error);
+        std::rethrow_exception(error);
+    }
+    promise.set_value(result);
+    return result;
+}
+
+void QueryCoalescer::allowDigest(const std::string& digest) {
+    std::lock_guard<std::mutex> lock(mu_);
+    allowed_digests_.insert(digest);
+}
+
+bool QueryCoalescer::isAllowed(const std::string& digest) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return allowed_digests_.count(digest) > 0;
+}
+
+QueryCoalescer::Stats QueryCoalescer::getStats() const {
+    return {executions_, shared_};
+}
+
+std::string QueryCoalescer::normalize(const std::string& sql) {
+    std::string normalized;
+    normalized.reserve(sql.size());
+
+    char quote = 0;
+    bool pending_space = false;
+    for (size_t i = 0; i < sql.size(); ++i) {
+        char c = sql[i];
+
+        if (quote) {
+            normalized += c;
+            if (c == '\\' && i + 1 < sql.size()) {
+                normalized += sql[++i];
+            } else if (c == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            pending_space = !normalized.empty();
+            continue;
+        }
+        if (pending_space) {
+            normalized += ' ';
+            pending_space = false;
+        }
+        if (c == '\'' || c == '"' || c == '`') {
+            quote = c;
+        }
+        normalized += c;
+    }
+
+    if (!normalized.empty() && normalized.back() == ';') {
+        normalized.pop_back();
+        if (!normalized.empty() && normalized.back() == ' ') {
+            normalized.pop_back();
+        }
+    }
+    return normalized;
+}
+
+std::string QueryCoalescer::digest(const std::string& normalized_sql) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : normalized_sql) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return hex;
+}
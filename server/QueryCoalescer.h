@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+// Single-flight layer for identical in-flight SELECTs: concurrent callers
+// with the same key wait on one execution and share its serialized result.
+class QueryCoalescer {
+public:
+    using Producer = std::function<std::string()>;
+
+    struct Stats {
+        uint64_t executions; // coalescable requests that ran the statement
+        uint64_t shared;     // requests served from another request's execution
+    };
+
+    // Run producer once per key among concurrent callers. Sets shared when
+    // the result came from another caller's execution. Rethrows its error.
+    std::string run(const std::string& key, const Producer& producer, bool& shared);
+
+    void allowDigest(const std::string& digest);
+    bool isAllowed(const std::string& digest) const;
+    Stats getStats() const;
+
+    // Collapse whitespace outside quoted literals and drop a trailing ';'
+    static std::string normalize(const std::string& sql);
+    // Hex FNV-1a digest of normalized SQL, used by the allow-list
+    static std::string digest(const std::string& normalized_sql);
+
+private:
+    mutable std::mutex mu_;
+    std::unordered_map<std::string, std::shared_future<std::string>> in_flight_;
+    std::unordered_set<std::string> allowed_digests_;
+
+    std::atomic<uint64_t> executions_{0};
+    std::atomic<uint64_t> shared_{0};
+};
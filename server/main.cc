@@ -1,32 +1,118 @@
 #include <iostream>
 #include <csignal>
 #include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cerrno>
+#include <pthread.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
 #include <spdlog/spdlog.h>
 #include "DatabaseServer.h"
 
-std::unique_ptr<DatabaseServer> server_ptr;
-
-void signalHandler(int signum) {
-    spdlog::info("Interrupt signal ({}) received. Shutting down server...", signum);
-    if (server_ptr) server_ptr->stop();
-    exit(signum);
-}
-
-int main() {
+int main(int argc, char* argv[]) {
     spdlog::set_level(spdlog::level::info);
 
     const std::string auth_token = "your_secret_token";
-    const int port = 8080;
+    int port = 8080;
+    std::string unix_socket;
+    std::vector<std::string> coalesce_digests;
+    std::chrono::seconds drain_timeout{30};
+
+    // Usage: server [--port <port>] [--unix <socket path>] [--coalesce-digest <digest>]...
+    //               [--drain-timeout <seconds>]
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--port") {
+            port = std::stoi(argv[i + 1]);
+        } else if (arg == "--unix") {
+            unix_socket = argv[i + 1];
+        } else if (arg == "--coalesce-digest") {
+            coalesce_digests.push_back(argv[i + 1]);
+        } else if (arg == "--drain-timeout") {
+            drain_timeout = std::chrono::seconds(std::stoi(argv[i + 1]));
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
 
-    server_ptr = std::make_unique<DatabaseServer>(auth_token);
+    // Block shutdown signals before any thread starts so every thread
+    // inherits the mask; the main thread reads them from a signalfd.
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    int signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        spdlog::error("Failed to create signalfd");
+        return 1;
+    }
 
-    std::signal(SIGINT, signalHandler);
-    std::signal(SIGTERM, signalHandler);
+    // Warm the pools before binding, so a replacement process only takes
+    // traffic once its connections are ready
+    auto server = std::make_unique<DatabaseServer>(auth_token);
+    for (const auto& digest : coalesce_digests) {
+        server->allowCoalescing(digest);
+    }
 
-    spdlog::info("Server started on http://localhost:{}", port);
+    bool bound = unix_socket.empty() ? server->bind(port) : server->bindUnix(unix_socket);
+    if (!bound) {
+        return 1;
+    }
+
+    // Wake the main thread if serve() returns without a signal, e.g.
+    // after an accept error
+    int serve_fd = eventfd(0, EFD_CLOEXEC);
+    if (serve_fd < 0) {
+        spdlog::error("Failed to create eventfd");
+        return 1;
+    }
+    std::thread serving([&server, serve_fd] {
+        server->serve();
+        uint64_t one = 1;
+        ssize_t written = write(serve_fd, &one, sizeof(one));
+        (void)written;
+    });
+
+    if (unix_socket.empty()) {
+        spdlog::info("Server started on http://localhost:{}", port);
+    } else {
+        spdlog::info("Server started on unix:{}", unix_socket);
+    }
     std::cout << "Press Ctrl+C to shutdown" << std::endl;
 
-    server_ptr->start(port);
+    pollfd fds[] = {{signal_fd, POLLIN, 0}, {serve_fd, POLLIN, 0}};
+    while (poll(fds, 2, -1) < 0 && errno == EINTR) {
+    }
+
+    bool serve_failed = !(fds[0].revents & POLLIN);
+    if (serve_failed) {
+        spdlog::error("Server stopped accepting unexpectedly. Shutting down server...");
+    } else {
+        signalfd_siginfo info{};
+        ssize_t n;
+        do {
+            n = read(signal_fd, &info, sizeof(info));
+        } while (n < 0 && errno == EINTR);
+        spdlog::info("Signal ({}) received. Shutting down server...", info.ssi_signo);
+    }
+    close(signal_fd);
+
+    if (!server->drain(drain_timeout)) {
+        // Workers still hold connections; skip destructors rather than
+        // tearing the pools down underneath them
+        spdlog::warn("Exiting without a clean drain");
+        std::_Exit(EXIT_FAILURE);
+    }
+    serving.join();
+    close(serve_fd);
 
-    return 0;
+    return serve_failed ? 1 : 0;
 }
@@ -1,13 +1,14 @@
 #include "CommonConnectionPool.h"
+#include "PoolRegistry.h"
 #include "public.h"
-#include <fstream>
-#include <sstream>
 #include <algorithm>
 
-ConnectionPool::ConnectionPool() {
-    if (!loadConfig("/etc/baby-dbcp/mysql.config")) {
-        throw std::runtime_error("Failed to load connection pool config");
-    }
+ConnectionPool& ConnectionPool::getConnectionPool() {
+    return PoolRegistry::getRegistry().getDefaultPool();
+}
+
+ConnectionPool::ConnectionPool(const std::string& name, const Config& config, ConnectionBudget& budget)
+    : _name(name), _config(config), _budget(budget) {
     initialize();
 }
 
@@ -15,78 +16,14 @@ ConnectionPool::~ConnectionPool() {
     shutdown();
 }
 
-bool ConnectionPool::loadConfig(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        LOG("Failed to open config file: " + filename);
-        return false;
-    }
-
-    std::unordered_map<std::string, std::string> configMap;
-    std::string line;
-    
-    while (std::getline(file, line)) {
-        std::cout << line << std::endl;
-        // Skip comments and empty lines
-        if (line.empty() || line[0] == '#' || line[0] == ';') {
-            continue;
-        }
-        
-        size_t pos = line.find('=');
-        if (pos != std::string::npos) {
-            std::string key = line.substr(0, pos);
-            std::string value = line.substr(pos + 1);
-            
-            // Trim whitespace
-            key.erase(0, key.find_first_not_of(" \t"));
-            key.erase(key.find_last_not_of(" \t") + 1);
-            value.erase(0, value.find_first_not_of(" \t"));
-            value.erase(value.find_last_not_of(" \t") + 1);
-            
-            configMap[key] = value;
-        }
-    }
-    std::cout << std::endl;
-
-    // Parse configuration with defaults
-    auto getConfig = [&](const std::string& key, const std::string& defaultValue = "") {
-        auto it = configMap.find(key);
-        return it != configMap.end() ? it->second : defaultValue;
-    };
-
-    _config.host = getConfig("host", "localhost");
-    _config.port = static_cast<uint16_t>(std::stoi(getConfig("port", "3306")));
-    _config.database = getConfig("dbname");
-    _config.username = getConfig("user");
-    _config.password = getConfig("password");
-    _config.minSize = std::stoul(getConfig("initSize", "5"));
-    _config.maxSize = std::stoul(getConfig("maxSize", "20"));
-    _config.maxIdleTime = std::chrono::seconds(std::stoi(getConfig("maxIdleTime", "60")));
-    _config.connectionTimeout = std::chrono::milliseconds(std::stoi(getConfig("connectionTimeout", "5000")));
-
-    // Validate required fields
-    if (_config.database.empty() || _config.username.empty() || _config.password.empty()) {
-        LOG("Missing required database credentials");
-        return false;
-    }
-
-    // Validate sizes
-    if (_config.minSize > _config.maxSize) {
-        LOG("Invalid pool size configuration");
-        return false;
-    }
-
-    return true;
-}
-
 void ConnectionPool::initialize() {
-    std::lock_guard<std::mutex> lock(_mu);
-    
-    // Create initial connections
+    // Create initial connections; the budget may ask other pools to shed
+    // idle connections, so no pool lock is held while creating them
     for (int i = 0; i < _config.minSize; ++i) {
         auto conn = createConnection();
         if (conn) {
-            _availableConnections.push(std::move(conn));
+            std::lock_guard<std::mutex> lock(_mu);
+            returnConnection(std::move(conn));
         } else {
             LOG("Failed to create initial connection");
             throw std::runtime_error("Failed to initialize connection pool");
@@ -96,8 +33,9 @@ void ConnectionPool::initialize() {
     // Start background threads
     _producer = std::thread(&ConnectionPool::producerThread, this);
     _sweeper = std::thread(&ConnectionPool::sweeperThread, this);
+    _resetter = std::thread(&ConnectionPool::resetterThread, this);
 
-    LOG("Connection pool initialized with " + std::to_string(_config.minSize) + " connections");
+    LOG("Connection pool " + _name + " initialized with " + std::to_string(_config.minSize) + " connections");
 }
 
 void ConnectionPool::shutdown() {
@@ -108,6 +46,8 @@ void ConnectionPool::shutdown() {
     
     _notEmpty.notify_all();
     _notFull.notify_all();
+    _dirtyPending.notify_all();
+    _sweeperWake.notify_all();
 
     if (_producer.joinable()) {
         _producer.join();
@@ -115,26 +55,87 @@ void ConnectionPool::shutdown() {
     if (_sweeper.joinable()) {
         _sweeper.join();
     }
+    if (_resetter.joinable()) {
+        _resetter.join();
+    }
 
     // Clear all connections
     std::lock_guard<std::mutex> lock(_mu);
     while (!_availableConnections.empty()) {
-        _availableConnections.pop();
+        discardConnection(std::move(_availableConnections.front()));
+        _availableConnections.pop_front();
+    }
+    while (!_dirtyConnections.empty()) {
+        discardConnection(std::move(_dirtyConnections.front()));
+        _dirtyConnections.pop();
     }
 }
 
 std::unique_ptr<Connection> ConnectionPool::createConnection() {
+    if (!_budget.acquire(this)) {
+        return nullptr;
+    }
+
     auto conn = std::make_unique<Connection>();
     
-    if (conn->connect(_config.host, _config.port, _config.username, 
-                     _config.password, _config.database)) {
+    bool connected = _config.unixSocket.empty()
+        ? conn->connect(_config.host, _config.port, _config.username,
+                        _config.password, _config.database)
+        : conn->connectUnix(_config.unixSocket, _config.username,
+                            _config.password, _config.database);
+    if (connected) {
         conn->refreshAliveTime();
         return conn;
     }
     
+    _budget.release();
     return nullptr;
 }
 
+void ConnectionPool::discardConnection(std::unique_ptr<Connection> conn) {
+    if (conn) {
+        conn.reset();
+        _budget.release();
+    }
+}
+
+void ConnectionPool::returnConnection(std::unique_ptr<Connection> conn) {
+    conn->markIdle();
+    _availableConnections.push_back(std::move(conn));
+    _notEmpty.notify_one();
+
+    // The sweeper sleeps a full maxIdleTime while nothing is above
+    // minSize; have it take its deadline from the front connection now
+    if (static_cast<int>(_availableConnections.size()) == _config.minSize + 1) {
+        _sweeperWake.notify_one();
+    }
+}
+
+std::unique_ptr<Connection> ConnectionPool::takeConnection() {
+    std::unique_ptr<Connection> conn;
+    if (_config.reusePolicy == ReusePolicy::LIFO) {
+        conn = std::move(_availableConnections.back());
+        _availableConnections.pop_back();
+    } else {
+        conn = std::move(_availableConnections.front());
+        _availableConnections.pop_front();
+    }
+    return conn;
+}
+
+bool ConnectionPool::shedIdleConnection() {
+    std::lock_guard<std::mutex> lock(_mu);
+    if (_shutdown || static_cast<int>(_availableConnections.size()) <= _config.minSize) {
+        return false;
+    }
+
+    // Shed the longest idle connection
+    discardConnection(std::move(_availableConnections.front()));
+    _availableConnections.pop_front();
+    LOG("Pool " + _name + " shed an idle connection");
+    return true;
+}
+
 std::shared_ptr<Connection> ConnectionPool::getConnection() {
     _totalRequests++;
     
@@ -155,20 +156,24 @@ std::shared_ptr<Connection> ConnectionPool::getConnection() {
         return nullptr;
     }
     
-    // Get connection from queue
-    auto conn = std::move(_availableConnections.front());
-    _availableConnections.pop();
+    // Get connection according to the reuse policy
+    auto conn = takeConnection();
+    _activeConnections++;
+    _notFull.notify_one();
+    lock.unlock();
     
     // Validate connection
     if (!conn->isConnected()) {
         // Only create new one if the pooled one is dead
+        discardConnection(std::move(conn));
         conn = createConnection();
         if (!conn) {
+            _activeConnections--;
+            _notFull.notify_one();
             return nullptr;
         }
     }
     
-    _activeConnections++;
     conn->refreshAliveTime();
     
     // Create shared_ptr with custom deleter
@@ -176,12 +181,16 @@ std::shared_ptr<Connection> ConnectionPool::getConnection() {
     return std::shared_ptr<Connection>(rawConn, 
         [this](Connection* c) {
             std::lock_guard<std::mutex> lock(_mu);
-            if (!_shutdown) {
-                _availableConnections.push(std::unique_ptr<Connection>(c));
+            if (!_shutdown && c->isDirty()) {
+                // Stays counted as active until the resetter hands it back
+                _dirtyConnections.push(std::unique_ptr<Connection>(c));
+                _dirtyPending.notify_one();
+            } else if (!_shutdown) {
+                returnConnection(std::unique_ptr<Connection>(c));
                 _activeConnections--;
-                _notEmpty.notify_one();
             } else {
                 delete c;
+                _budget.release();
             }
         });
 }
@@ -193,7 +202,7 @@ void ConnectionPool::producerThread() {
         // Wait if we have enough connections
         _notFull.wait(lock, [this] {
             return _shutdown|| 
-                   (static_cast<int>(_availableConnections.size()) + _activeConnections <= _config.maxSize &&
+                   (static_cast<int>(_availableConnections.size()) + _activeConnections < _config.maxSize &&
                     static_cast<int>(_availableConnections.size()) < _config.minSize);
         });
         
@@ -205,31 +214,73 @@ void ConnectionPool::producerThread() {
         lock.lock();
         
         if (conn && !_shutdown) {
-            _availableConnections.push(std::move(conn));
-            _notEmpty.notify_one();
+            returnConnection(std::move(conn));
+        } else if (conn) {
+            discardConnection(std::move(conn));
+        } else if (!_shutdown) {
+            // Global budget exhausted or database unreachable; back off
+            _notFull.wait_for(lock, std::chrono::milliseconds(100));
         }
     }
 }
 
 void ConnectionPool::sweeperThread() {
+    std::unique_lock<std::mutex> lock(_mu);
+
     while (!_shutdown) {
-        std::this_thread::sleep_for(std::chrono::seconds(_config.maxIdleTime));
-        
-        std::lock_guard<std::mutex> lock(_mu);
-        
+        auto now = std::chrono::steady_clock::now();
+
+        // Don't sweep below minimum size; the front is always the longest idle
+        while (static_cast<int>(_availableConnections.size()) > _config.minSize &&
+               now - _availableConnections.front()->getIdleSince() >= _config.maxIdleTime) {
+            discardConnection(std::move(_availableConnections.front()));
+            _availableConnections.pop_front();
+            LOG("Swept idle connection");
+        }
+
+        // Sleep until the oldest surplus connection expires; shutdown and
+        // returns that cross minSize wake us early
+        auto wake = now + _config.maxIdleTime;
+        if (static_cast<int>(_availableConnections.size()) > _config.minSize) {
+            wake = _availableConnections.front()->getIdleSince() + _config.maxIdleTime;
+        }
+        _sweeperWake.wait_until(lock, wake);
+    }
+}
+
+void ConnectionPool::resetterThread() {
+    while (true) {
+        std::unique_lock<std::mutex> lock(_mu);
+        _dirtyPending.wait(lock, [this] {
+            return _shutdown || !_dirtyConnections.empty();
+        });
+
         if (_shutdown) break;
-        
-        // Don't sweep below minimum size
-        while (static_cast<int>(_availableConnections.size()) > _config.minSize) {
-            auto& conn = _availableConnections.front();
-            
-            if (conn->getAliveTime() > _config.maxIdleTime) {
-                _availableConnections.pop();
-                LOG("Swept idle connection");
-            } else {
-                // Queue is ordered, so we can stop
-                break;
-            }
+
+        auto conn = std::move(_dirtyConnections.front());
+        _dirtyConnections.pop();
+
+        // Reset outside the lock; a connection whose session cannot be
+        // reset is dropped and the producer replaces it
+        lock.unlock();
+        bool ok = conn->reset();
+        if (!ok) {
+            LOG("Dropped connection whose session could not be reset");
+            discardConnection(std::move(conn));
+        }
+        lock.lock();
+
+        if (ok) {
+            _resetCount++;
+        } else {
+            _resetDropCount++;
+        }
+        _activeConnections--;
+        if (ok && !_shutdown) {
+            returnConnection(std::move(conn));
+        } else {
+            discardConnection(std::move(conn));
+            _notFull.notify_one();
         }
     }
 }
@@ -241,6 +292,8 @@ ConnectionPool::Stats ConnectionPool::getStats() const {
         _availableConnections.size(),
         _activeConnections,
         _totalRequests,
-        _timeoutCount
+        _timeoutCount,
+        _resetCount,
+        _resetDropCount
     };
 }
\ No newline at end of file
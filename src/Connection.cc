@@ -4,6 +4,126 @@
 #include "cppconn/prepared_statement.h"
 #include <iostream>
 #include <sstream>
+#include <cctype>
+#include <cstring>
+#include <strings.h>
+#include <initializer_list>
+
+namespace {
+
+// What a statement may leave behind in the session for the next borrower
+enum class SessionEffect {
+    None,       // plain reads, autocommit DML, DDL
+    Resettable, // transactions, USE, LOCK TABLES, autocommit, named locks
+    Reconnect   // session/user variables, temporary tables, anything unknown
+};
+
+bool wordIs(const char* begin, size_t length, const char* word) {
+    return std::strlen(word) == length && strncasecmp(begin, word, length) == 0;
+}
+
+bool wordIn(const char* begin, size_t length, std::initializer_list<const char*> words) {
+    for (const char* word : words) {
+        if (wordIs(begin, length, word)) return true;
+    }
+    return false;
+}
+
+// One pass over the statement without copying it. Quoted literals,
+// quoted identifiers and comments are skipped, so row data (e.g. an
+// e-mail address in an INSERT) never affects the result.
+SessionEffect sessionEffect(const std::string& sql) {
+    const char* s = sql.data();
+    const size_t n = sql.size();
+
+    SessionEffect effect = SessionEffect::None;
+    bool firstWord = true;
+    bool secondWord = false;
+    bool isSet = false;
+    bool setsOnlyAutocommit = false;
+
+    size_t i = 0;
+    while (i < n) {
+        char c = s[i];
+
+        if (c == '\'' || c == '"' || c == '`') {
+            for (++i; i < n && s[i] != c; ++i) {
+                if (s[i] == '\\' && c != '`') ++i;
+            }
+            ++i;
+            continue;
+        }
+        if (c == '#' || (c == '-' && i + 2 < n && s[i + 1] == '-' && std::isspace(static_cast<unsigned char>(s[i + 2])))) {
+            while (i < n && s[i] != '\n') ++i;
+            continue;
+        }
+        if (c == '/' && i + 1 < n && s[i + 1] == '*') {
+            size_t close = sql.find("*/", i + 2);
+            i = close == std::string::npos ? n : close + 2;
+            continue;
+        }
+        if (c == '@') {
+            // @@var reads a system variable; @var is a user variable
+            if (i + 1 < n && s[i + 1] == '@') {
+                i += 2;
+                while (i < n && (std::isalnum(static_cast<unsigned char>(s[i])) || s[i] == '_' || s[i] == '.')) ++i;
+                continue;
+            }
+            return SessionEffect::Reconnect;
+        }
+        if (c == ',' && isSet) {
+            setsOnlyAutocommit = false;
+        }
+
+        if (!std::isalpha(static_cast<unsigned char>(c)) && c != '_') {
+            ++i;
+            continue;
+        }
+
+        size_t begin = i;
+        while (i < n && (std::isalnum(static_cast<unsigned char>(s[i])) || s[i] == '_')) ++i;
+        const char* word = s + begin;
+        size_t length = i - begin;
+
+        if (firstWord) {
+            firstWord = false;
+            secondWord = true;
+            if (wordIs(word, length, "SET")) {
+                isSet = true;
+            } else if (wordIn(word, length, {"BEGIN", "START", "COMMIT", "ROLLBACK", "SAVEPOINT",
+                                             "RELEASE", "USE", "LOCK", "UNLOCK"})) {
+                effect = SessionEffect::Resettable;
+            } else if (!wordIn(word, length, {"SELECT", "SHOW", "DESC", "DESCRIBE", "EXPLAIN",
+                                              "INSERT", "UPDATE", "DELETE", "REPLACE", "WITH",
+                                              "CREATE", "DROP", "ALTER", "TRUNCATE", "RENAME"})) {
+                return SessionEffect::Reconnect;
+            }
+            continue;
+        }
+
+        if (secondWord) {
+            secondWord = false;
+            if (isSet) {
+                setsOnlyAutocommit = wordIs(word, length, "AUTOCOMMIT");
+                effect = SessionEffect::Resettable;
+            }
+        }
+
+        if (wordIs(word, length, "TEMPORARY")) {
+            return SessionEffect::Reconnect;
+        }
+        if (wordIs(word, length, "GET_LOCK")) {
+            effect = SessionEffect::Resettable;
+        }
+    }
+
+    if (isSet && !setsOnlyAutocommit) {
+        return SessionEffect::Reconnect;
+    }
+    return effect;
+}
+
+} // namespace
 
 Connection::Connection() : _conn(nullptr), _driver(nullptr) {
     try {
@@ -22,17 +142,31 @@ bool Connection::connect(std::string ip,
                         std::string user,
                         std::string password,
                         std::string dbname) {
+    // Build connection string
+    std::ostringstream connectionString;
+    connectionString << "tcp://" << ip << ":" << port;
+
+    return connectUrl(connectionString.str(), user, password, dbname);
+}
+
+bool Connection::connectUnix(std::string socketPath,
+                            std::string user,
+                            std::string password,
+                            std::string dbname) {
+    return connectUrl("unix://" + socketPath, user, password, dbname);
+}
+
+bool Connection::connectUrl(const std::string& url,
+                           const std::string& user,
+                           const std::string& password,
+                           const std::string& dbname) {
     try {
         if (!_driver) {
             return false;
         }
         
-        // Build connection string
-        std::ostringstream connectionString;
-        connectionString << "tcp://" << ip << ":" << port;
-        
         // Create connection
-        _conn.reset(_driver->connect(connectionString.str(), user, password));
+        _conn.reset(_driver->connect(url, user, password));
         
         if (!_conn) {
             LOG("Failed to create connection");
@@ -41,6 +175,9 @@ bool Connection::connect(std::string ip,
         
         // Set database schema
         _conn->setSchema(dbname);
+        _dbname = dbname;
+        _dirty = false;
+        _needsReconnect = false;
 
         return true;
         
@@ -72,6 +209,8 @@ bool Connection::update(std::string sql) {
         return false;
     }
     
+    noteSessionEffect(sql);
+
     try {
         std::unique_ptr<sql::Statement> stmt(_conn->createStatement());
         int affectedRows = stmt->executeUpdate(sql);
@@ -79,8 +218,9 @@ bool Connection::update(std::string sql) {
         return affectedRows >= 0;
         
     } catch (sql::SQLException& e) {
-        LOG("Update failed: " + std::string(e.what()) + 
-                    " (Error code: " + std::to_string(e.getErrorCode()) + ")");
+        _lastError = std::string(e.what()) +
+                    " (Error code: " + std::to_string(e.getErrorCode()) + ")";
+        LOG("Update failed: " + _lastError);
         return false;
     }
 
@@ -93,12 +233,51 @@ std::unique_ptr<sql::ResultSet> Connection::query(std::string sql) {
         return nullptr;
     }
 
+    noteSessionEffect(sql);
+
     try {
         std::unique_ptr<sql::Statement> stmt(_conn->createStatement());
         return std::unique_ptr<sql::ResultSet>(stmt->executeQuery(sql));
     } catch (sql::SQLException& e) {
-        LOG("Update failed: " + std::string(e.what()) + 
-                    " (Error code: " + std::to_string(e.getErrorCode()) + ")");
+        _lastError = std::string(e.what()) +
+                    " (Error code: " + std::to_string(e.getErrorCode()) + ")";
+        LOG("Update failed: " + _lastError);
         return nullptr;
     }
+}
+
+void Connection::noteSessionEffect(const std::string& sql) {
+    switch (sessionEffect(sql)) {
+        case SessionEffect::Reconnect:
+            markNeedsReconnect();
+            break;
+        case SessionEffect::Resettable:
+            markDirty();
+            break;
+        case SessionEffect::None:
+            break;
+    }
+}
+
+bool Connection::reset() {
+    // Variables and temporary tables cannot be cleared without
+    // COM_RESET_CONNECTION, which Connector/C++ does not expose
+    if (!isConnected() || _needsReconnect) {
+        return false;
+    }
+
+    try {
+        std::unique_ptr<sql::Statement> stmt(_conn->createStatement());
+        stmt->execute("ROLLBACK");
+        stmt->execute("UNLOCK TABLES");
+        stmt->execute("DO RELEASE_ALL_LOCKS()");
+        _conn->setAutoCommit(true);
+        _conn->setSchema(_dbname);
+        _dirty = false;
+        return true;
+    } catch (sql::SQLException& e) {
+        LOG("Reset failed: " + std::string(e.what()) + 
+                    " (Error code: " + std::to_string(e.getErrorCode()) + ")");
+        return false;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "PoolRegistry.h"
+#include "public.h"
+#include <fstream>
+#include <unordered_map>
+
+void ConnectionBudget::addPool(ConnectionPool* pool) {
+    std::lock_guard<std::mutex> lock(_mu);
+    _pools.push_back(pool);
+}
+
+bool ConnectionBudget::acquire(const ConnectionPool* requester) {
+    std::vector<ConnectionPool*> pools;
+    {
+        std::lock_guard<std::mutex> lock(_mu);
+        if (_used < _maxSize) {
+            _used++;
+            return true;
+        }
+        pools = _pools;
+    }
+
+    // Budget exhausted: take an idle connection back from another pool.
+    // Our lock is not held here since shedding calls release().
+    for (auto* pool : pools) {
+        if (pool == requester || !pool->shedIdleConnection()) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(_mu);
+        if (_used < _maxSize) {
+            _used++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ConnectionBudget::release() {
+    std::lock_guard<std::mutex> lock(_mu);
+    _used--;
+}
+
+int ConnectionBudget::getUsed() const {
+    std::lock_guard<std::mutex> lock(_mu);
+    return _used;
+}
+
+PoolRegistry::PoolRegistry() {
+    if (!loadConfig("/etc/baby-dbcp/mysql.config")) {
+        throw std::runtime_error("Failed to load connection pool config");
+    }
+
+    _budget = std::make_unique<ConnectionBudget>(_globalMaxSize);
+    for (const auto& entry : _configs) {
+        auto pool = std::unique_ptr<ConnectionPool>(
+            new ConnectionPool(entry.first, entry.second, *_budget));
+        _budget->addPool(pool.get());
+        _pools[entry.first] = std::move(pool);
+    }
+
+    auto it = _pools.find("default");
+    _default = it != _pools.end() ? it->second.get() : _pools.begin()->second.get();
+}
+
+PoolRegistry::~PoolRegistry() {
+    // Stop every pool's threads before any pool is destroyed, since a
+    // producer may ask another pool to shed a connection
+    for (auto& entry : _pools) {
+        entry.second->shutdown();
+    }
+    _pools.clear();
+}
+
+bool PoolRegistry::loadConfig(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        LOG("Failed to open config file: " + filename);
+        return false;
+    }
+
+    // Keys before the first [section] apply to every pool
+    std::unordered_map<std::string, std::string> globalMap;
+    std::map<std::string, std::unordered_map<std::string, std::string>> sectionMaps;
+    std::unordered_map<std::string, std::string>* current = &globalMap;
+    std::string line;
+    
+    while (std::getline(file, line)) {
+        // Skip comments and empty lines
+        if (line.empty() || line[0] == '#' || line[0] == ';') {
+            continue;
+        }
+
+        if (line[0] == '[') {
+            size_t close = line.find(']');
+            if (close == std::string::npos) {
+                LOG("Malformed section header: " + line);
+                return false;
+            }
+            current = &sectionMaps[line.substr(1, close - 1)];
+            continue;
+        }
+        
+        size_t pos = line.find('=');
+        if (pos != std::string::npos) {
+            std::string key = line.substr(0, pos);
+            std::string value = line.substr(pos + 1);
+            
+            // Trim whitespace
+            key.erase(0, key.find_first_not_of(" \t"));
+            key.erase(key.find_last_not_of(" \t") + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
+            value.erase(value.find_last_not_of(" \t") + 1);
+            
+            (*current)[key] = value;
+        }
+    }
+
+    if (sectionMaps.empty()) {
+        sectionMaps["default"];
+    }
+
+    int minTotal = 0;
+    int maxTotal = 0;
+    for (const auto& section : sectionMaps) {
+        const std::string& name = section.first;
+        const auto& configMap = section.second;
+
+        // Parse configuration with defaults
+        auto getConfig = [&](const std::string& key, const std::string& defaultValue = "") {
+            auto it = configMap.find(key);
+            if (it != configMap.end()) return it->second;
+            it = globalMap.find(key);
+            return it != globalMap.end() ? it->second : defaultValue;
+        };
+
+        ConnectionPool::Config config;
+        config.host = getConfig("host", "localhost");
+        config.port = static_cast<uint16_t>(std::stoi(getConfig("port", "3306")));
+        config.unixSocket = getConfig("unixSocket");
+        config.database = getConfig("dbname");
+        config.username = getConfig("user");
+        config.password = getConfig("password");
+        config.minSize = std::stoul(getConfig("initSize", "5"));
+        config.maxSize = std::stoul(getConfig("maxSize", "20"));
+        config.maxIdleTime = std::chrono::seconds(std::stoi(getConfig("maxIdleTime", "60")));
+        config.connectionTimeout = std::chrono::milliseconds(std::stoi(getConfig("connectionTimeout", "5000")));
+
+        std::string reusePolicy = getConfig("reusePolicy", "fifo");
+        if (reusePolicy == "lifo" || reusePolicy == "mru") {
+            config.reusePolicy = ConnectionPool::ReusePolicy::LIFO;
+        } else if (reusePolicy != "fifo") {
+            LOG("Unknown reusePolicy " + reusePolicy + " for pool " + name);
+            return false;
+        }
+
+        // Validate required fields
+        if (config.database.empty() || config.username.empty() || config.password.empty()) {
+            LOG("Missing required database credentials for pool " + name);
+            return false;
+        }
+
+        // Validate sizes
+        if (config.minSize > config.maxSize) {
+            LOG("Invalid pool size configuration for pool " + name);
+            return false;
+        }
+
+        minTotal += config.minSize;
+        maxTotal += config.maxSize;
+        _configs[name] = config;
+    }
+
+    auto it = globalMap.find("globalMaxSize");
+    _globalMaxSize = it != globalMap.end() ? std::stoi(it->second) : maxTotal;
+    if (_globalMaxSize < minTotal) {
+        LOG("globalMaxSize is smaller than the sum of initSize");
+        return false;
+    }
+
+    return true;
+}
+
+ConnectionPool* PoolRegistry::getPool(const std::string& name) const {
+    auto it = _pools.find(name);
+    return it != _pools.end() ? it->second.get() : nullptr;
+}
+
+std::vector<std::string> PoolRegistry::getPoolNames() const {
+    std::vector<std::string> names;
+    for (const auto& entry : _pools) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+ConnectionPool::Stats PoolRegistry::getAggregateStats() const {
+    ConnectionPool::Stats total{0, 0, 0, 0, 0, 0, 0};
+    for (const auto& entry : _pools) {
+        auto stats = entry.second->getStats();
+        total.totalConnections += stats.totalConnections;
+        total.availableConnections += stats.availableConnections;
+        total.activeConnections += stats.activeConnections;
+        total.totalRequests += stats.totalRequests;
+        total.timeoutCount += stats.timeoutCount;
+        total.resetCount += stats.resetCount;
+        total.resetDropCount += stats.resetDropCount;
+    }
+    return total;
+}
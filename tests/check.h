@@ -0,0 +1,13 @@
+#pragma once
+
+#include <iostream>
+
+// Shared by the unit tests that need no database: count failed checks
+// instead of stopping, and report them from main()
+inline int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        std::cout << __FILE__ << ":" << __LINE__ << " CHECK failed: " #cond << std::endl; \
+        failures++; \
+    }
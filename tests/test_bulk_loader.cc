@@ -0,0 +1,239 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include "BulkLoader.h"
+#include "check.h"
+
+// Records every statement instead of sending it to MySQL
+struct FakeConnection {
+    std::mutex mu;
+    std::vector<std::string> statements;
+    int failAt = -1; // fail the n-th statement, 0-based
+
+    BulkLoader::Executor executor() {
+        return [this](const std::string& sql, std::string& error) {
+            std::lock_guard<std::mutex> lock(mu);
+            if (static_cast<int>(statements.size()) == failAt) {
+                error = "Duplicate entry '1' for key 'PRIMARY' (Error code: 1062)";
+                return false;
+            }
+            statements.push_back(sql);
+            return true;
+        };
+    }
+};
+
+// Feed the body in chunks of chunkSize so tokens straddle chunk boundaries
+void feedAll(BulkLoader& loader, const std::string& body, size_t chunkSize) {
+    for (size_t i = 0; i < body.size(); i += chunkSize) {
+        loader.feed(body.data() + i, std::min(chunkSize, body.size() - i));
+    }
+}
+
+bool throwsFormatError(const std::function<void()>& op) {
+    try {
+        op();
+    } catch (const BulkLoader::FormatError&) {
+        return true;
+    } catch (...) {
+        return false;
+    }
+    return false;
+}
+
+void testCsvQuotingAcrossChunks() {
+    std::cout << "CSV quoting across chunks" << std::endl;
+    for (size_t chunk : {1, 2, 3, 7, 64}) {
+        FakeConnection conn;
+        BulkLoader loader(conn.executor(), "t", BulkLoader::Format::CSV, 1 << 20);
+        feedAll(loader, "a,b\r\n1,\"x,\"\"y\"\"\nz\"\n\\N,\"\\N\"\n\n3,", chunk);
+        loader.finish();
+
+        CHECK(loader.rows() == 3);
+        CHECK(loader.committedRows() == 3);
+        CHECK(conn.statements.size() == 1);
+        CHECK(conn.statements[0] ==
+              "INSERT INTO `t` (`a`,`b`) VALUES ('1','x,\\\"y\\\"\\nz'),(NULL,'\\\\N'),('3','')");
+    }
+}
+
+void testCsvFieldCountMismatch() {
+    std::cout << "CSV field count mismatch" << std::endl;
+    FakeConnection conn;
+    BulkLoader loader(conn.executor(), "t", BulkLoader::Format::CSV, 1 << 20);
+    CHECK(throwsFormatError([&] { feedAll(loader, "a,b\n1,2\n3\n", 4); }));
+}
+
+void testCsvRecordWithoutNewline() {
+    std::cout << "CSV record without newline" << std::endl;
+    std::string commas(1 << 20, ',');
+    for (std::string header : {"a\n", ""}) {
+        FakeConnection conn;
+        BulkLoader loader(conn.executor(), "t", BulkLoader::Format::CSV, 4096);
+        // Rejected after the extra field or batch_bytes, not at the end of the body
+        size_t fed = 0;
+        CHECK(throwsFormatError([&] {
+            loader.feed(header.data(), header.size());
+            for (; fed < 64; ++fed) {
+                loader.feed(commas.data(), commas.size());
+            }
+        }));
+        CHECK(fed == 0);
+    }
+}
+
+void testCsvRowLargerThanBatch() {
+    std::cout << "CSV row larger than batch" << std::endl;
+    FakeConnection conn;
+    BulkLoader loader(conn.executor(), "t", BulkLoader::Format::CSV, 64);
+    // Each field and the raw record fit, but the quoted INSERT does not
+    std::string field(18, 'x');
+    CHECK(throwsFormatError([&] { feedAll(loader, "a,b,c\n" + field + "," + field + "," + field + "\n", 16); }));
+    CHECK(conn.statements.empty());
+}
+
+void testCsvUnterminatedQuote() {
+    std::cout << "CSV unterminated quote" << std::endl;
+    FakeConnection conn;
+    BulkLoader loader(conn.executor(), "t", BulkLoader::Format::CSV, 1 << 20);
+    feedAll(loader, "a\n\"open", 3);
+    CHECK(throwsFormatError([&] { loader.finish(); }));
+}
+
+void testNdjsonValues() {
+    std::cout << "NDJSON values" << std::endl;
+    FakeConnection conn;
+    BulkLoader loader(conn.executor(), "t", BulkLoader::Format::NDJSON, 1 << 20);
+    feedAll(loader, "{\"a\":1,\"b\":\"it's\"}\n{\"b\":null,\"a\":true}\n\n{\"a\":2.5}", 5);
+    loader.finish();
+
+    CHECK(loader.rows() == 3);
+    CHECK(conn.statements.size() == 1);
+    CHECK(conn.statements[0] ==
+          "INSERT INTO `t` (`a`,`b`) VALUES (1,'it\\'s'),(1,NULL),(2.5,NULL)");
+}
+
+void testNdjsonUnknownKey() {
+    std::cout << "NDJSON unknown key" << std::endl;
+    FakeConnection conn;
+    BulkLoader loader(conn.executor(), "t", BulkLoader::Format::NDJSON, 1 << 20);
+    CHECK(throwsFormatError([&] { feedAll(loader, "{\"a\":1}\n{\"a\":2,\"c\":3}\n", 64); }));
+}
+
+void testNdjsonMalformed() {
+    std::cout << "NDJSON malformed row" << std::endl;
+    for (const char* body : {"{\"a\":1}\n[1]\n", "{\"a\":\n"}) {
+        FakeConnection conn;
+        BulkLoader loader(conn.executor(), "t", BulkLoader::Format::NDJSON, 1 << 20);
+        CHECK(throwsFormatError([&] { feedAll(loader, body, 64); }));
+    }
+}
+
+void testBatchSplitting() {
+    std::cout << "Batch splitting" << std::endl;
+    FakeConnection conn;
+    BulkLoader loader(conn.executor(), "t", BulkLoader::Format::CSV, 64);
+    std::string body = "id\n";
+    for (int i = 0; i < 100; ++i) {
+        body += std::to_string(i) + "\n";
+    }
+    feedAll(loader, body, 16);
+    loader.finish();
+
+    CHECK(loader.rows() == 100);
+    CHECK(loader.committedRows() == 100);
+    CHECK(loader.batches() == conn.statements.size());
+    CHECK(conn.statements.size() > 1);
+    for (const auto& sql : conn.statements) {
+        CHECK(sql.size() <= 64);
+    }
+}
+
+void testFailedBatchReportsCommitted() {
+    std::cout << "Failed batch reports committed rows" << std::endl;
+    FakeConnection conn;
+    conn.failAt = 1;
+    BulkLoader loader(conn.executor(), "t", BulkLoader::Format::CSV, 64);
+    std::string body = "id\n";
+    for (int i = 0; i < 100; ++i) {
+        body += std::to_string(i) + "\n";
+    }
+
+    std::string message;
+    try {
+        feedAll(loader, body, 16);
+        loader.finish();
+    } catch (const BulkLoader::FormatError&) {
+        message = "unexpected format error";
+    } catch (const std::exception& e) {
+        message = e.what();
+    }
+    loader.abort();
+
+    CHECK(message.find("Duplicate entry") != std::string::npos);
+    CHECK(loader.committedBatches() == 1);
+    CHECK(loader.committedRows() > 0);
+    CHECK(loader.committedRows() < 100);
+}
+
+void testAbortDropsPendingBatch() {
+    std::cout << "Abort drops pending batch" << std::endl;
+    FakeConnection conn;
+    auto record = conn.executor();
+
+    // Hold the first batch in the executor so the next one stays pending
+    std::mutex mu;
+    std::condition_variable cv;
+    bool released = false;
+    auto blocking = [&](const std::string& sql, std::string& error) {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&] { return released; });
+        return record(sql, error);
+    };
+
+    BulkLoader loader(blocking, "t", BulkLoader::Format::CSV, 64);
+    loader.feed("id\n", 3);
+    for (int i = 0; loader.batches() < 2; ++i) {
+        std::string row = std::to_string(i) + "\n";
+        loader.feed(row.data(), row.size());
+    }
+
+    std::thread aborter([&] { loader.abort(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        released = true;
+    }
+    cv.notify_all();
+    aborter.join();
+
+    // Only the batch the writer already held ran
+    CHECK(loader.batches() == 2);
+    CHECK(conn.statements.size() == 1);
+    CHECK(loader.committedBatches() == 1);
+}
+
+int main() {
+    std::cout << "Testing BulkLoader\n";
+    std::cout << "==================\n\n";
+
+    testCsvQuotingAcrossChunks();
+    testCsvFieldCountMismatch();
+    testCsvRecordWithoutNewline();
+    testCsvRowLargerThanBatch();
+    testCsvUnterminatedQuote();
+    testNdjsonValues();
+    testNdjsonUnknownKey();
+    testNdjsonMalformed();
+    testBatchSplitting();
+    testFailedBatchReportsCommitted();
+    testAbortDropsPendingBatch();
+
+    std::cout << "\nFailures: " << failures << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include "QueryCoalescer.h"
+#include "check.h"
+
+void testNormalize() {
+    std::cout << "normalize" << std::endl;
+    CHECK(QueryCoalescer::normalize("  SELECT  *\n\tFROM t  ") == "SELECT * FROM t");
+    CHECK(QueryCoalescer::normalize("SELECT 1 ;") == "SELECT 1");
+    CHECK(QueryCoalescer::normalize("SELECT 1;") == "SELECT 1");
+    // Whitespace inside quoted literals and identifiers is significant
+    CHECK(QueryCoalescer::normalize("SELECT * FROM t WHERE a = 'x  y'") ==
+          "SELECT * FROM t WHERE a = 'x  y'");
+    CHECK(QueryCoalescer::normalize("SELECT `a  b` FROM t") == "SELECT `a  b` FROM t");
+    CHECK(QueryCoalescer::normalize("SELECT 'it\\'s  ok',  2") == "SELECT 'it\\'s  ok', 2");
+    CHECK(QueryCoalescer::normalize("") == "");
+}
+
+void testDigest() {
+    std::cout << "digest" << std::endl;
+    std::string digest = QueryCoalescer::digest("SELECT 1");
+    CHECK(digest.size() == 16);
+    CHECK(digest.find_first_not_of("0123456789abcdef") == std::string::npos);
+    CHECK(digest == QueryCoalescer::digest("SELECT 1"));
+    CHECK(digest != QueryCoalescer::digest("SELECT 2"));
+    CHECK(QueryCoalescer::digest(QueryCoalescer::normalize("SELECT   1;")) == digest);
+}
+
+void testAllowList() {
+    std::cout << "allow-list" << std::endl;
+    QueryCoalescer coalescer;
+    std::string digest = QueryCoalescer::digest("SELECT 1");
+    CHECK(!coalescer.isAllowed(digest));
+    coalescer.allowDigest(digest);
+    CHECK(coalescer.isAllowed(digest));
+}
+
+void testConcurrentCallersShareOneExecution() {
+    std::cout << "concurrent callers share one execution" << std::endl;
+    QueryCoalescer coalescer;
+    std::atomic<int> executions{0};
+    std::atomic<int> sharedCount{0};
+    std::atomic<int> wrong{0};
+
+    const int numThreads = 20;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back([&] {
+            bool shared = false;
+            auto result = coalescer.run("k", [&] {
+                executions++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                return std::string("result");
+            }, shared);
+            if (result != "result") wrong++;
+            if (shared) sharedCount++;
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    CHECK(wrong == 0);
+    CHECK(executions == 1);
+    CHECK(sharedCount == numThreads - 1);
+    auto stats = coalescer.getStats();
+    CHECK(stats.executions == 1);
+    CHECK(stats.shared == static_cast<uint64_t>(numThreads - 1));
+}
+
+void testSequentialCallersRunAgain() {
+    std::cout << "sequential callers run again" << std::endl;
+    QueryCoalescer coalescer;
+    int executions = 0;
+    for (int i = 0; i < 3; ++i) {
+        bool shared = true;
+        coalescer.run("k", [&] { executions++; return std::string("r"); }, shared);
+        CHECK(!shared);
+    }
+    CHECK(executions == 3);
+}
+
+void testErrorsReachEveryWaiter() {
+    std::cout << "errors reach every waiter" << std::endl;
+    QueryCoalescer coalescer;
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 5; ++i) {
+        threads.emplace_back([&] {
+            bool shared = false;
+            try {
+                coalescer.run("k", [] () -> std::string {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    throw std::runtime_error("No connection available");
+                }, shared);
+            } catch (const std::runtime_error&) {
+                errors++;
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    CHECK(errors == 5);
+
+    // A failed execution is not cached
+    bool shared = true;
+    CHECK(coalescer.run("k", [] { return std::string("ok"); }, shared) == "ok");
+    CHECK(!shared);
+}
+
+int main() {
+    std::cout << "Testing QueryCoalescer\n";
+    std::cout << "======================\n\n";
+
+    testNormalize();
+    testDigest();
+    testAllowList();
+    testConcurrentCallersShareOneExecution();
+    testSequentialCallersRunAgain();
+    testErrorsReachEveryWaiter();
+
+    std::cout << "\nFailures: " << failures << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <functional>
+#include <unistd.h>
+#include <httplib.h>
+#include "Connection.h"
+
+const int iterations = 1000;
+
+double timeIterations(const std::function<bool()>& op, int& failures) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        if (!op()) {
+            failures++;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void report(const std::string& mode, double totalMs, int failures) {
+    std::cout << mode << ": total " << totalMs << " ms, avg "
+              << totalMs / iterations << " ms per round trip, failures "
+              << failures << std::endl;
+}
+
+void testMySQLRoundTrip() {
+    std::cout << "\n=== MySQL round trip (SELECT 1) ===" << std::endl;
+
+    std::string host = "localhost";
+    unsigned short port = 3306;
+    std::string socketPath = "/var/run/mysqld/mysqld.sock";
+    std::string user = "testuser";
+    std::string password = "Test@1234";
+    std::string database = "testdb";
+
+    Connection tcpConn;
+    if (tcpConn.connect(host, port, user, password, database)) {
+        int failures = 0;
+        double ms = timeIterations([&] { return tcpConn.query("SELECT 1") != nullptr; }, failures);
+        report("TCP ", ms, failures);
+    } else {
+        std::cout << "TCP connection to " << host << ":" << port << " failed" << std::endl;
+    }
+
+    Connection udsConn;
+    if (udsConn.connectUnix(socketPath, user, password, database)) {
+        int failures = 0;
+        double ms = timeIterations([&] { return udsConn.query("SELECT 1") != nullptr; }, failures);
+        report("UDS ", ms, failures);
+    } else {
+        std::cout << "UDS connection to " << socketPath << " failed" << std::endl;
+    }
+}
+
+void testHttpRoundTrip() {
+    std::cout << "\n=== HTTP round trip (GET /ping) ===" << std::endl;
+
+    const int tcpPort = 18080;
+    const std::string socketPath = "/tmp/baby-dbcp-bench.sock";
+
+    auto handler = [](const httplib::Request&, httplib::Response& res) {
+        res.set_content("{\"status\":\"ok\"}", "application/json");
+    };
+
+    httplib::Server tcpServer;
+    tcpServer.Get("/ping", handler);
+    std::thread tcpThread([&] { tcpServer.listen("127.0.0.1", tcpPort); });
+
+    httplib::Server udsServer;
+    udsServer.Get("/ping", handler);
+    ::unlink(socketPath.c_str());
+    udsServer.set_address_family(AF_UNIX);
+    std::thread udsThread([&] { udsServer.listen(socketPath, 80); });
+
+    tcpServer.wait_until_ready();
+    udsServer.wait_until_ready();
+
+    {
+        httplib::Client cli("127.0.0.1", tcpPort);
+        cli.set_keep_alive(true);
+        int failures = 0;
+        double ms = timeIterations([&] {
+            auto res = cli.Get("/ping");
+            return res && res->status == 200;
+        }, failures);
+        report("TCP ", ms, failures);
+    }
+
+    {
+        httplib::Client cli(socketPath, 80);
+        cli.set_address_family(AF_UNIX);
+        cli.set_keep_alive(true);
+        int failures = 0;
+        double ms = timeIterations([&] {
+            auto res = cli.Get("/ping");
+            return res && res->status == 200;
+        }, failures);
+        report("UDS ", ms, failures);
+    }
+
+    tcpServer.stop();
+    udsServer.stop();
+    tcpThread.join();
+    udsThread.join();
+    ::unlink(socketPath.c_str());
+}
+
+int main() {
+    std::cout << "Testing TCP vs Unix domain socket latency\n";
+    std::cout << "=========================================\n";
+
+    testMySQLRoundTrip();
+    testHttpRoundTrip();
+    return 0;
+}